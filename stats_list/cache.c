@@ -0,0 +1,289 @@
+/****************************************************************************
+ *          CACHE.C
+ *
+ *          Incremental cache of decoded records of a metric.
+ *
+ *          Copyright (c) 2018 Niyamaka.
+ *          All Rights Reserved.
+ ****************************************************************************/
+#include <stdio.h>
+#include <errno.h>
+#include <dirent.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "cache.h"
+
+/***************************************************************************
+ *              Constants
+ ***************************************************************************/
+#define CACHE_READ_RETRIES  3
+
+typedef enum {
+    FILES_UNCHANGED = 0,
+    FILES_APPENDED,     // same files, grown or with the last bucket rewritten, maybe new files
+    FILES_CHANGED,      // some file removed or truncated: read all again
+} files_state_t;
+
+/***************************************************************************
+ *  Size and mtime of the regular files of the metric directory.
+ ***************************************************************************/
+PRIVATE json_t *files_snapshot(const char *metric_dir)
+{
+    DIR *dir = opendir(metric_dir);
+    if(!dir) {
+        return 0;
+    }
+
+    json_t *jn_files = json_object();
+    int dfd = dirfd(dir);
+    struct dirent *de;
+    while((de = readdir(dir))) {
+        if(de->d_name[0] == '.') {
+            continue;
+        }
+        struct stat st;
+        if(fstatat(dfd, de->d_name, &st, 0)<0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        json_object_set_new(jn_files, de->d_name, json_pack("{s:I, s:I}",
+            "size", (json_int_t)st.st_size,
+            "mtime", (json_int_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec
+        ));
+    }
+    closedir(dir);
+
+    return jn_files;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE files_state_t files_compare(json_t *jn_cached, json_t *jn_current)
+{
+    files_state_t state = FILES_UNCHANGED;
+
+    const char *name;
+    json_t *jn_file;
+    json_object_foreach(jn_cached, name, jn_file) {
+        json_t *jn_now = json_object_get(jn_current, name);
+        if(!jn_now) {
+            return FILES_CHANGED;
+        }
+        json_int_t size = kw_get_int(jn_file, "size", 0, 0);
+        json_int_t size_now = kw_get_int(jn_now, "size", 0, 0);
+        if(size_now < size) {
+            return FILES_CHANGED;
+        }
+        if(size_now != size ||
+                kw_get_int(jn_file, "mtime", 0, 0) != kw_get_int(jn_now, "mtime", 0, 0)) {
+            state = FILES_APPENDED;
+        }
+    }
+    if(json_object_size(jn_current) != json_object_size(jn_cached)) {
+        state = FILES_APPENDED; // new files
+    }
+
+    return state;
+}
+
+/***************************************************************************
+ *  Name of cache file: FNV-1a of the key.
+ ***************************************************************************/
+PRIVATE void cache_path(char *bf, int bfsize, const char *cache_dir, const char *key)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for(const unsigned char *p = (const unsigned char *)key; *p; p++) {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+    snprintf(bf, bfsize, "%s/%016llx.json", cache_dir, (unsigned long long)hash);
+}
+
+/***************************************************************************
+ *  Save the cache. Written in a temporal file and renamed,
+ *  a concurrent reader sees the old or the new cache, never a partial one.
+ ***************************************************************************/
+PRIVATE int cache_save(const char *path, json_t *jn_cache)
+{
+    char temp[PATH_MAX];
+    snprintf(temp, sizeof(temp), "%s.%d", path, (int)getpid());
+    if(json_dump_file(jn_cache, temp, JSON_COMPACT)<0) {
+        return -1;
+    }
+    if(rename(temp, path)<0) {
+        unlink(temp);
+        return -1;
+    }
+    return 0;
+}
+
+/***************************************************************************
+ *  Read the records from `from_t` until the end.
+ *  The files are snapshotted before and after, if a writer changed them
+ *  meanwhile the read is repeated, so the snapshot returned is never
+ *  newer than the records (at worst the next read will get the tail again).
+ ***************************************************************************/
+PRIVATE json_t *read_records(const char *metric_dir, json_t *metric, uint64_t from_t, json_t **jn_files)
+{
+    json_t *jn_data = 0;
+    json_t *jn_before = 0;
+
+    for(int i=0; i<CACHE_READ_RETRIES; i++) {
+        JSON_DECREF(jn_data);
+        JSON_DECREF(jn_before);
+
+        jn_before = files_snapshot(metric_dir);
+        jn_data = rstats_get_data(metric, from_t, (uint64_t)-1);
+        json_t *jn_after = files_snapshot(metric_dir);
+        files_state_t state = files_compare(jn_before, jn_after);
+        JSON_DECREF(jn_after);
+        if(state == FILES_UNCHANGED) {
+            break;
+        }
+    }
+
+    *jn_files = jn_before;
+    return jn_data;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE json_t *select_records(json_t *jn_data, uint64_t from_t, uint64_t to_t)
+{
+    json_t *jn_list = json_array();
+
+    size_t idx;
+    json_t *jn_record;
+    json_array_foreach(jn_data, idx, jn_record) {
+        uint64_t fr_t = kw_get_int(jn_record, "fr_t", 0, KW_WILD_NUMBER);
+        if(fr_t >= from_t && fr_t <= to_t) {
+            json_array_append(jn_list, jn_record);
+        }
+    }
+
+    return jn_list;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+json_t *cache_get_data(
+    const char *cache_dir,
+    const char *metric_dir,
+    const char *key,
+    json_t *metric,
+    uint64_t from_t,
+    uint64_t to_t)
+{
+    if(mkdir(cache_dir, 0775)<0 && errno != EEXIST) {
+        return rstats_get_data(metric, from_t, to_t);
+    }
+
+    char path[PATH_MAX];
+    cache_path(path, sizeof(path), cache_dir, key);
+
+    json_t *jn_current = files_snapshot(metric_dir);
+    if(!jn_current) {
+        return rstats_get_data(metric, from_t, to_t);
+    }
+
+    /*
+     *  Check the cache: same metric, covering from_t, files not rewritten.
+     */
+    files_state_t state = FILES_CHANGED;
+    json_t *jn_cache = json_load_file(path, 0, 0);
+    if(jn_cache) {
+        if(strcmp(kw_get_str(jn_cache, "key", "", 0), key)==0 &&
+                (uint64_t)kw_get_int(jn_cache, "from_t", 0, KW_WILD_NUMBER) <= from_t &&
+                json_is_array(json_object_get(jn_cache, "data"))) {
+            state = files_compare(kw_get_dict(jn_cache, "files", 0, 0), jn_current);
+        }
+    }
+    JSON_DECREF(jn_current);
+
+    json_t *jn_files = 0;
+    json_t *jn_data = 0;
+    switch(state) {
+        case FILES_UNCHANGED:
+            jn_data = json_incref(json_object_get(jn_cache, "data"));
+            break;
+
+        case FILES_APPENDED:
+            {
+                /*
+                 *  The last cached bucket can be incomplete,
+                 *  read again from it and replace it.
+                 */
+                json_t *jn_cached = json_object_get(jn_cache, "data");
+                size_t items = json_array_size(jn_cached);
+                uint64_t hwm_t = from_t;
+                if(items) {
+                    hwm_t = kw_get_int(json_array_get(jn_cached, items-1), "fr_t", 0, KW_WILD_NUMBER);
+                    hwm_t = MAX(hwm_t, from_t);
+                }
+                json_t *jn_tail = read_records(metric_dir, metric, hwm_t, &jn_files);
+                if(!jn_tail) {
+                    /*
+                     *  Keep the cache as it is, the tail will be read next time.
+                     */
+                    JSON_DECREF(jn_files);
+                    jn_data = json_incref(jn_cached);
+                    break;
+                }
+
+                /*
+                 *  Trim the cache to the window asked,
+                 *  it must not grow with every read.
+                 */
+                jn_data = json_array();
+                size_t idx;
+                json_t *jn_record;
+                json_array_foreach(jn_cached, idx, jn_record) {
+                    uint64_t fr_t = kw_get_int(jn_record, "fr_t", 0, KW_WILD_NUMBER);
+                    if(fr_t >= hwm_t) {
+                        break;
+                    }
+                    if(fr_t >= from_t) {
+                        json_array_append(jn_data, jn_record);
+                    }
+                }
+                json_array_extend(jn_data, jn_tail);
+                JSON_DECREF(jn_tail);
+
+                json_object_set_new(jn_cache, "data", json_incref(jn_data));
+                json_object_set_new(jn_cache, "from_t", json_integer(from_t));
+                if(jn_files) {
+                    json_object_set_new(jn_cache, "files", jn_files);
+                    cache_save(path, jn_cache);
+                }
+            }
+            break;
+
+        case FILES_CHANGED:
+        default:
+            JSON_DECREF(jn_cache);
+            jn_data = read_records(metric_dir, metric, from_t, &jn_files);
+            if(!jn_data) {
+                JSON_DECREF(jn_files);
+                return 0;
+            }
+            if(jn_files) {
+                jn_cache = json_pack("{s:s, s:I, s:o, s:O}",
+                    "key", key,
+                    "from_t", (json_int_t)from_t,
+                    "files", jn_files,
+                    "data", jn_data
+                );
+                cache_save(path, jn_cache);
+            }
+            break;
+    }
+
+    json_t *jn_list = select_records(jn_data, from_t, to_t);
+    JSON_DECREF(jn_data);
+    JSON_DECREF(jn_cache);
+
+    return jn_list;
+}
@@ -0,0 +1,46 @@
+/****************************************************************************
+ *          CACHE.H
+ *
+ *          Incremental cache of decoded records of a metric.
+ *
+ *          The records read from a metric are saved in a cache file
+ *          together with the size and mtime of the metric files.
+ *          In the next read, if the files have only grown or changed
+ *          in their last record (stats are appended, and the current
+ *          bucket is updated in place), only the tail from the last
+ *          cached record is read again and merged.
+ *          When saved, the cache is trimmed to the window asked.
+ *
+ *          Copyright (c) 2018 Niyamaka.
+ *          All Rights Reserved.
+ ****************************************************************************/
+#pragma once
+
+#include <ghelpers.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/***************************************************************
+ *              Prototypes
+ ***************************************************************/
+/*
+ *  Return the records of `metric` with fr_t in [from_t, to_t], a new list.
+ *  `metric_dir` is the directory with the files of the metric,
+ *  `key` identifies the metric (database, group, variable, metric)
+ *  and names its cache file inside of `cache_dir`.
+ *  If the cache can't be used the records are read with rstats_get_data().
+ */
+json_t *cache_get_data(
+    const char *cache_dir,
+    const char *metric_dir,
+    const char *key,
+    json_t *metric,
+    uint64_t from_t,
+    uint64_t to_t
+);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,109 @@
+/****************************************************************************
+ *          KERNELS.C
+ *
+ *          Vectorized kernels over arrays of doubles.
+ *
+ *          Written with the GCC vector extensions, 2 doubles per vector,
+ *          the width of the baseline SIMD (SSE2, NEON): the compiler emits
+ *          SIMD instructions
+ *          without depending on the auto-vectorizer or on -ffast-math,
+ *          which a floating point sum needs to be reordered.
+ *          The build compiles this file with -O2.
+ *
+ *          Copyright (c) 2018 Niyamaka.
+ *          All Rights Reserved.
+ ****************************************************************************/
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include "kernels.h"
+
+/***************************************************************************
+ *              Structures
+ ***************************************************************************/
+#define VEC_LANES   2
+
+typedef double v2d __attribute__((vector_size(VEC_LANES*sizeof(double))));
+typedef int64_t v2i __attribute__((vector_size(VEC_LANES*sizeof(int64_t))));
+
+/***************************************************************************
+ *  Unaligned load/store
+ ***************************************************************************/
+static inline v2d v2d_load(const double *p)
+{
+    v2d v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void v2d_store(double *p, v2d v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline v2d v2d_abs(v2d v)
+{
+    const v2i mask = {INT64_MAX, INT64_MAX};
+    return (v2d)((v2i)v & mask);
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+void vec_sub(double *d, const double *a, const double *b, size_t n)
+{
+    size_t i = 0;
+    for(; i + VEC_LANES <= n; i += VEC_LANES) {
+        v2d_store(d + i, v2d_load(a + i) - v2d_load(b + i));
+    }
+    for(; i < n; i++) {
+        d[i] = a[i] - b[i];
+    }
+}
+
+/***************************************************************************
+ *  Partial sums by lane, added at end.
+ ***************************************************************************/
+double vec_sum(const double *a, size_t n)
+{
+    v2d acc = {0, 0};
+    size_t i = 0;
+    for(; i + VEC_LANES <= n; i += VEC_LANES) {
+        acc += v2d_load(a + i);
+    }
+    double sum = acc[0] + acc[1];
+    for(; i < n; i++) {
+        sum += a[i];
+    }
+    return sum;
+}
+
+/***************************************************************************
+ *  Max reduction of |a[i]| by lanes (compare and blend, no branches),
+ *  then a scalar search of the first index with that value.
+ ***************************************************************************/
+size_t vec_max_abs_index(const double *a, size_t n)
+{
+    v2d vmax = {0, 0};
+    size_t i = 0;
+    for(; i + VEC_LANES <= n; i += VEC_LANES) {
+        v2d v = v2d_abs(v2d_load(a + i));
+        v2i gt = v > vmax;
+        vmax = (v2d)(((v2i)v & gt) | ((v2i)vmax & ~gt));
+    }
+    double max_v = 0;
+    for(int l=0; l<VEC_LANES; l++) {
+        max_v = vmax[l] > max_v? vmax[l] : max_v;
+    }
+    for(; i < n; i++) {
+        double v = fabs(a[i]);
+        max_v = v > max_v? v : max_v;
+    }
+
+    for(i = 0; i < n; i++) {
+        if(fabs(a[i]) == max_v) {
+            return i;
+        }
+    }
+    return 0;
+}
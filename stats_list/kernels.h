@@ -0,0 +1,37 @@
+/****************************************************************************
+ *          KERNELS.H
+ *
+ *          Vectorized kernels over arrays of doubles.
+ *
+ *          Copyright (c) 2018 Niyamaka.
+ *          All Rights Reserved.
+ ****************************************************************************/
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/***************************************************************
+ *              Prototypes
+ ***************************************************************/
+/*
+ *  d[i] = a[i] - b[i]
+ */
+void vec_sub(double *d, const double *a, const double *b, size_t n);
+
+/*
+ *  Sum of a[].
+ */
+double vec_sum(const double *a, size_t n);
+
+/*
+ *  Index of the greatest |a[i]|, the first one if repeated. 0 if n is 0.
+ */
+size_t vec_max_abs_index(const double *a, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
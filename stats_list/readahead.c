@@ -0,0 +1,176 @@
+/****************************************************************************
+ *          READAHEAD.C
+ *
+ *          Asynchronous read-ahead of metric files.
+ *
+ *          Copyright (c) 2018 Niyamaka.
+ *          All Rights Reserved.
+ ****************************************************************************/
+#include <stdio.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "readahead.h"
+
+/***************************************************************************
+ *              Structures
+ ***************************************************************************/
+/*
+ *  Workers don't touch json or gbmem, only plain libc,
+ *  so they are safe with the non thread-safe helpers of the main thread.
+ */
+struct readahead_s {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int stopping;
+
+    int depth;          // capacity of the ring
+    int head;           // next slot to consume
+    int count;          // slots pending
+    char (*ring)[PATH_MAX];
+
+    int workers;
+    pthread_t *threads;
+};
+
+/***************************************************************************
+ *  Read the file into the page cache.
+ ***************************************************************************/
+static void warm_file(const char *path)
+{
+    int fd = open(path, O_RDONLY|O_CLOEXEC);
+    if(fd < 0) {
+        return;
+    }
+    struct stat st;
+    if(fstat(fd, &st)==0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        /*
+         *  readahead() blocks this worker until the pages are queued,
+         *  that's the point: the main thread is parsing meanwhile.
+         */
+        if(readahead(fd, 0, (size_t)st.st_size) < 0) {
+            posix_fadvise(fd, 0, st.st_size, POSIX_FADV_WILLNEED);
+        }
+    }
+    close(fd);
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+static void *worker_thread(void *arg)
+{
+    readahead_t *ra = arg;
+    char path[PATH_MAX];
+
+    pthread_mutex_lock(&ra->mutex);
+    while(1) {
+        while(!ra->stopping && ra->count == 0) {
+            pthread_cond_wait(&ra->cond, &ra->mutex);
+        }
+        if(ra->stopping) {
+            break;
+        }
+        snprintf(path, sizeof(path), "%s", ra->ring[ra->head]);
+        ra->head = (ra->head + 1) % ra->depth;
+        ra->count--;
+
+        pthread_mutex_unlock(&ra->mutex);
+        warm_file(path);
+        pthread_mutex_lock(&ra->mutex);
+    }
+    pthread_mutex_unlock(&ra->mutex);
+
+    return 0;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+readahead_t *readahead_create(int workers, int depth)
+{
+    if(workers <= 0 || depth <= 0) {
+        return 0;
+    }
+
+    readahead_t *ra = calloc(1, sizeof(readahead_t));
+    if(!ra) {
+        return 0;
+    }
+    ra->depth = depth;
+    ra->ring = calloc((size_t)depth, sizeof(*ra->ring));
+    ra->threads = calloc((size_t)workers, sizeof(pthread_t));
+    if(!ra->ring || !ra->threads) {
+        free(ra->ring);
+        free(ra->threads);
+        free(ra);
+        return 0;
+    }
+    pthread_mutex_init(&ra->mutex, 0);
+    pthread_cond_init(&ra->cond, 0);
+
+    for(int i=0; i<workers; i++) {
+        if(pthread_create(&ra->threads[i], 0, worker_thread, ra)!=0) {
+            break;
+        }
+        ra->workers++;
+    }
+    if(ra->workers == 0) {
+        readahead_destroy(ra);
+        return 0;
+    }
+
+    return ra;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+void readahead_destroy(readahead_t *ra)
+{
+    if(!ra) {
+        return;
+    }
+
+    pthread_mutex_lock(&ra->mutex);
+    ra->stopping = 1;
+    pthread_cond_broadcast(&ra->cond);
+    pthread_mutex_unlock(&ra->mutex);
+
+    for(int i=0; i<ra->workers; i++) {
+        pthread_join(ra->threads[i], 0);
+    }
+
+    pthread_cond_destroy(&ra->cond);
+    pthread_mutex_destroy(&ra->mutex);
+    free(ra->threads);
+    free(ra->ring);
+    free(ra);
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+int readahead_submit(readahead_t *ra, const char *path)
+{
+    if(!ra || !path || !*path) {
+        return -1;
+    }
+
+    int ret = -1;
+    pthread_mutex_lock(&ra->mutex);
+    if(ra->count < ra->depth) {
+        int tail = (ra->head + ra->count) % ra->depth;
+        snprintf(ra->ring[tail], PATH_MAX, "%s", path);
+        ra->count++;
+        pthread_cond_signal(&ra->cond);
+        ret = 0;
+    }
+    pthread_mutex_unlock(&ra->mutex);
+
+    return ret;
+}
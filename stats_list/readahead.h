@@ -0,0 +1,49 @@
+/****************************************************************************
+ *          READAHEAD.H
+ *
+ *          Asynchronous read-ahead of metric files.
+ *
+ *          A small pool of threads warms the page cache with the data files
+ *          of the next metrics while the current one is parsed,
+ *          so cold-cache recursive listings keep the disk queue busy.
+ *
+ *          Copyright (c) 2018 Niyamaka.
+ *          All Rights Reserved.
+ ****************************************************************************/
+#pragma once
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/***************************************************************
+ *              Structures
+ ***************************************************************/
+typedef struct readahead_s readahead_t;
+
+/***************************************************************
+ *              Prototypes
+ ***************************************************************/
+/*
+ *  Create the read-ahead stage.
+ *  `workers` threads, at most `depth` files pending.
+ *  Return NULL on error (caller must go on without read-ahead).
+ */
+readahead_t *readahead_create(int workers, int depth);
+
+/*
+ *  Stop the workers and free resources.
+ *  Files still pending are discarded.
+ */
+void readahead_destroy(readahead_t *ra);
+
+/*
+ *  Queue the file `path` to be read into the page cache.
+ *  It's only a hint: it never blocks, when the queue is full the request is dropped.
+ *  Return 0 if queued, -1 if dropped.
+ */
+int readahead_submit(readahead_t *ra, const char *path);
+
+#ifdef __cplusplus
+}
+#endif
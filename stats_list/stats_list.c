@@ -8,6 +8,7 @@
  ****************************************************************************/
 #include <stdio.h>
 #include <argp.h>
+#include <dirent.h>
 #include <time.h>
 #include <errno.h>
 #include <regex.h>
@@ -15,9 +16,17 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <strings.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 #include <string.h>
 #include <time.h>
 #include <ghelpers.h>
+#include "readahead.h"
+#include "transforms.h"
+#include "cache.h"
+#include "kernels.h"
 
 /***************************************************************************
  *              Constants
@@ -29,6 +38,13 @@
 #define SUPPORT     "<niyamaka at yuneta.io>"
 #define DATETIME    __DATE__ " " __TIME__
 
+#define READAHEAD_WORKERS   4
+#define READAHEAD_DEPTH     8
+#define READAHEAD_FILES     16  // pending files per metric read ahead
+
+#define GAPS_SLICE_PERIODS  1000    // periods read at once when files have no range
+#define COMPARE_SLICE_PERIODS 1000  // periods read at once by --compare
+
 /***************************************************************************
  *              Structures
  ***************************************************************************/
@@ -44,28 +60,69 @@ struct arguments
     char *path;
     char *group;
     int recursive;
+    int regex;
     int raw;
     int verbose;
     int limits;
+    int readahead;
+    char *cache_dir;
 
     char *from_t;
     char *to_t;
+    char *compare;
+
+    int gaps;
+    char *stale;
+    int jobs;
+
+    char *rolling;
+    char *rolling_fn;
+    char *ewma;
 
     char *variable;
     char *metric;
     char *units;
 };
 
+typedef struct {
+    BOOL active;
+    BOOL is_regex;
+    const char *exact;
+    regex_t re;
+} name_filter_t;
+
 typedef struct {
     char path_simple_stats[PATH_MAX];
     struct arguments *arguments;
     json_t *match_cond;
+    json_t *jn_found;           // metrics found by the walk, pending to list
+    readahead_t *readahead;
+    char readahead_group[PATH_MAX];     // group opened to know the files to read ahead
+    json_t *readahead_stats;
+    json_t *readahead_variables;
+    name_filter_t group_filter;
+    name_filter_t metric_filter;
+    name_filter_t variable_filter;
+    json_t *jn_groups;          // groups found by the walk, pending to scan for gaps
 } list_params_t;
 
+typedef struct {
+    list_params_t *list_params;
+    uint64_t stale_t;
+    pthread_mutex_t mutex;      // process-shared, protects next, counters and stdout
+    size_t next;                // next group to scan
+    int metrics;
+    int gaps;
+    int stale;
+    int unscanned;
+} gaps_scan_t;
+
 /***************************************************************************
  *              Prototypes
  ***************************************************************************/
 static error_t parse_opt (int key, char *arg, struct argp_state *state);
+PRIVATE int collect_groups(list_params_t *list_params, const char *database);
+PRIVATE uint64_t period_seconds(const char *period, BOOL *calendar);
 
 /***************************************************************************
  *      Data
@@ -92,7 +149,10 @@ static struct argp_option options[] = {
 {"path",                'a',    "PATH",             0,      "Path.",            2},
 {"group",               'b',    "GROUP",            0,      "Group.",           2},
 {"recursive",           'r',    0,                  0,      "List recursively.",2},
+{"cache-dir",           13,     "DIR",              0,      "Cache the records read in DIR, next reads only parse what was appended.", 2},
+{"regex",               12,     0,                  0,      "Group, metric and variable of recursive listing or gaps are regular expressions.", 2},
 {"raw",                 10,     0,                  0,      "List rawly.",      2},
+{"readahead",           11,     "DEPTH",            0,      "Metrics to read ahead when listing recursively a range of time (0 disable, default 8).", 2},
 
 {0,                     0,      0,                  0,      "Presentation",     3},
 {"verbose",             'l',    0,                  0,      "Verbose",          3},
@@ -100,9 +160,20 @@ static struct argp_option options[] = {
 {0,                     0,      0,                  0,      "Search conditions", 4},
 {"from-t",              1,      "TIME",             0,      "From time.",       4},
 {"to-t",                2,      "TIME",             0,      "To time.",         4},
+{"compare",             4,      "FROM,TO",          0,      "Compare with other window of time (delta = value - compare value).", 4},
 
 {"limits",              3,      0,                  0,      "Show limits",      5},
 
+{0,                     0,      0,                  0,      "Health",           6},
+{"gaps",                5,      0,                  0,      "Scan all the metrics of path for gaps in their records.", 6},
+{"stale",               6,      "TIME",             0,      "With --gaps, report metrics without records since TIME.", 6},
+{"jobs",                'j',    "JOBS",             0,      "With --gaps, processes scanning groups in parallel (default number of cpus).", 6},
+
+{0,                     0,      0,                  0,      "Transforms",       7},
+{"rolling",             7,      "WINDOW",           0,      "Add the rolling function of the last WINDOW records.", 7},
+{"fn",                  8,      "FN",               0,      "Rolling function: mean (default), max, stddev.", 7},
+{"ewma",                9,      "ALPHA",            0,      "Add the exponentially weighted moving average, 0 < ALPHA <= 1.", 7},
+
 {"variable",            21,     "VARIABLE",         0,      "Variable.",        9},
 {"metric",              22,     "METRIC",           0,      "Metric.",          10},
 {"units",               23,     "UNITS",            0,      "Units (SEC, MIN, HOUR, MDAY, MON, YEAR, WDAY, YDAY, CENT).",          11},
@@ -143,6 +214,15 @@ static error_t parse_opt (int key, char *arg, struct argp_state *state)
     case 10:
         arguments->raw = 1;
         break;
+    case 11:
+        arguments->readahead = atoi(arg);
+        break;
+    case 12:
+        arguments->regex = 1;
+        break;
+    case 13:
+        arguments->cache_dir = arg;
+        break;
     case 'l':
         arguments->verbose = 1;
         break;
@@ -157,6 +237,29 @@ static error_t parse_opt (int key, char *arg, struct argp_state *state)
     case 3:
         arguments->limits = 1;
         break;
+    case 4: // compare window
+        arguments->compare = arg;
+        break;
+
+    case 5:
+        arguments->gaps = 1;
+        break;
+    case 6:
+        arguments->stale = arg;
+        break;
+    case 'j':
+        arguments->jobs = atoi(arg);
+        break;
+
+    case 7:
+        arguments->rolling = arg;
+        break;
+    case 8:
+        arguments->rolling_fn = arg;
+        break;
+    case 9:
+        arguments->ewma = arg;
+        break;
 
     case 21:
         arguments->variable = arg;
@@ -266,6 +369,234 @@ PRIVATE void print_limits(json_t *jn_metric)
     }
 }
 
+/***************************************************************************
+ *  Number of the bucket of t counting from the bucket of from_t,
+ *  by period step, or by calendar step for calendar periods.
+ ***************************************************************************/
+PRIVATE int64_t bucket_number(uint64_t t, uint64_t from_t, const char *period, uint64_t period_secs, BOOL calendar)
+{
+    if(!calendar) {
+        return (int64_t)(t / period_secs) - (int64_t)(from_t / period_secs);
+    }
+
+    time_t tt = (time_t)t;
+    time_t tf = (time_t)from_t;
+    struct tm tm_t, tm_f;
+    gmtime_r(&tt, &tm_t);
+    gmtime_r(&tf, &tm_f);
+    int64_t year_t = tm_t.tm_year + 1900;
+    int64_t year_f = tm_f.tm_year + 1900;
+
+    if(strcasecmp(period, "MON")==0) {
+        return (year_t*12 + tm_t.tm_mon) - (year_f*12 + tm_f.tm_mon);
+    } else if(strcasecmp(period, "YEAR")==0) {
+        return year_t - year_f;
+    }
+    return year_t/100 - year_f/100; // CENT
+}
+
+/***************************************************************************
+ *  Load the values of a window in plain arrays, with the bucket number
+ *  of each record counting from the bucket of the start asked;
+ *  records of buckets before it are ignored.
+ *  Records are read in slices of COMPARE_SLICE_PERIODS periods,
+ *  so only a slice of json is in memory beside the arrays.
+ *  Return the number of records, the arrays must be freed with gbmem_free().
+ ***************************************************************************/
+PRIVATE size_t load_window(
+    json_t *metric,
+    uint64_t from_t,
+    uint64_t to_t,
+    int64_t **buckets_,
+    double **values_
+)
+{
+    const char *period = kw_get_str(metric, "period", "", 0);
+    BOOL calendar;
+    uint64_t period_secs = period_seconds(period, &calendar);
+    uint64_t slice = COMPARE_SLICE_PERIODS * (period_secs? period_secs : 60*60);
+    uint64_t end_t = MIN(to_t, (uint64_t)time(0));
+
+    int64_t *buckets = 0;
+    double *values = 0;
+    size_t n = 0;
+    size_t size = 0;
+    uint64_t last_fr_t = 0;
+
+    for(uint64_t fr_t = from_t; ; fr_t += slice) {
+        BOOL last_slice = fr_t > end_t || end_t - fr_t < slice;
+        json_t *jn_data = rstats_get_data(metric, fr_t, last_slice? to_t : fr_t + slice - 1);
+
+        size_t idx;
+        json_t *jn_record;
+        json_array_foreach(jn_data, idx, jn_record) {
+            uint64_t r_fr_t = kw_get_int(jn_record, "fr_t", 0, KW_REQUIRED|KW_WILD_NUMBER);
+            if(n > 0 && r_fr_t <= last_fr_t) {
+                continue; // already seen, slices can overlap
+            }
+            int64_t bucket = period_secs?
+                bucket_number(r_fr_t, from_t, period, period_secs, calendar) :
+                (int64_t)n; // unknown period: by order
+            if(bucket < 0) {
+                continue;
+            }
+            if(n == size) {
+                size = size? size*2 : 1024;
+                buckets = gbmem_realloc(buckets, size * sizeof(int64_t));
+                values = gbmem_realloc(values, size * sizeof(double));
+                if(!buckets || !values) {
+                    fprintf(stderr, "No memory for %lu records\n\n", (unsigned long)size);
+                    exit(-1);
+                }
+            }
+            buckets[n] = bucket;
+            values[n] = json_number_value(json_object_get(jn_record, "value"));
+            last_fr_t = r_fr_t;
+            n++;
+        }
+        JSON_DECREF(jn_data);
+
+        if(last_slice) {
+            break;
+        }
+    }
+
+    *buckets_ = buckets;
+    *values_ = values;
+    return n;
+}
+
+/***************************************************************************
+ *  Print per-bucket deltas and summary of two windows of the same metric.
+ *  Buckets are aligned by their number from the bucket of the start asked
+ *  of each window.
+ *  delta = value - compare value.
+ ***************************************************************************/
+PRIVATE int compare_windows(
+    json_t *metric,
+    uint64_t from_t,
+    uint64_t to_t,
+    uint64_t from2_t,
+    uint64_t to2_t
+)
+{
+    int64_t *bkt1, *bkt2;
+    double *val1, *val2;
+    size_t n1 = load_window(metric, from_t, to_t, &bkt1, &val1);
+    size_t n2 = load_window(metric, from2_t, to2_t, &bkt2, &val2);
+
+    /*
+     *  Align in place: the matched pairs are packed at the start of bkt1/val1/val2.
+     */
+    size_t n = 0;
+    size_t i = 0, j = 0;
+    while(i < n1 && j < n2) {
+        if(bkt1[i] < bkt2[j]) {
+            i++;
+        } else if(bkt1[i] > bkt2[j]) {
+            j++;
+        } else {
+            bkt1[n] = bkt1[i];
+            val1[n] = val1[i];
+            val2[n] = val2[j];
+            n++;
+            i++;
+            j++;
+        }
+    }
+
+    printf("%-12s %20s %20s %20s\n", "Bucket", "Value", "Compare", "Delta");
+    if(n > 0) {
+        double *delta = gbmem_malloc(n * sizeof(double));
+        if(!delta) {
+            fprintf(stderr, "No memory for %lu records\n\n", (unsigned long)n);
+            exit(-1);
+        }
+        vec_sub(delta, val1, val2, n);
+
+        for(size_t k=0; k<n; k++) {
+            printf("%-12lld %20.6f %20.6f %20.6f\n",
+                (long long)bkt1[k], val1[k], val2[k], delta[k]
+            );
+        }
+
+        double mean1 = vec_sum(val1, n) / n;
+        double mean2 = vec_sum(val2, n) / n;
+        size_t max_i = vec_max_abs_index(delta, n);
+
+        printf("\n");
+        printf("    Buckets:    %lu (%lu / %lu)\n", (unsigned long)n, (unsigned long)n1, (unsigned long)n2);
+        printf("    Mean:       %f\n", mean1);
+        printf("    Mean comp:  %f\n", mean2);
+        printf("    Mean shift: %f\n", mean1 - mean2);
+        printf("    Max delta:  %f at bucket %lld\n", delta[max_i], (long long)bkt1[max_i]);
+        if(mean2 != 0) {
+            printf("    Ratio:      %f\n", mean1 / mean2);
+        } else {
+            printf("    Ratio:      -\n");
+        }
+
+        gbmem_free(delta);
+    } else {
+        printf("\n");
+        printf("    Buckets:    0 (%lu / %lu)\n", (unsigned long)n1, (unsigned long)n2);
+    }
+
+    if(n1) {
+        gbmem_free(bkt1);
+        gbmem_free(val1);
+    }
+    if(n2) {
+        gbmem_free(bkt2);
+        gbmem_free(val2);
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+ *  Apply the streaming transforms to the records, in order.
+ *  The result is added to each record: "rolling_<fn>" and "ewma".
+ ***************************************************************************/
+PRIVATE int apply_transforms(json_t *jn_data, json_t *match_cond)
+{
+    size_t window = kw_get_int(match_cond, "rolling", 0, KW_WILD_NUMBER);
+    const char *fn_name = kw_get_str(match_cond, "rolling_fn", "mean", 0);
+    double alpha = kw_get_real(match_cond, "ewma", 0, 0);
+    if(!window && !alpha) {
+        return 0;
+    }
+
+    rolling_t rolling;
+    char rolling_key[32];
+    if(window) {
+        if(rolling_init(&rolling, rolling_fn_from_name(fn_name), window)<0) {
+            fprintf(stderr, "No memory for rolling window of %lu\n\n", (unsigned long)window);
+            exit(-1);
+        }
+        snprintf(rolling_key, sizeof(rolling_key), "rolling_%s", fn_name);
+    }
+    ewma_t ewma;
+    ewma_init(&ewma, alpha);
+
+    size_t idx;
+    json_t *jn_record;
+    json_array_foreach(jn_data, idx, jn_record) {
+        double value = json_number_value(json_object_get(jn_record, "value"));
+        if(window) {
+            json_object_set_new(jn_record, rolling_key, json_real(rolling_push(&rolling, value)));
+        }
+        if(alpha) {
+            json_object_set_new(jn_record, "ewma", json_real(ewma_push(&ewma, value)));
+        }
+    }
+
+    if(window) {
+        rolling_end(&rolling);
+    }
+    return 0;
+}
+
 /***************************************************************************
  *
  ***************************************************************************/
@@ -273,6 +604,7 @@ PRIVATE int _list_stats(
     char *path,
     char *group_name,
     char *metric_name_,
+    const char *variable_,
     json_t *match_cond,
     int verbose
 )
@@ -320,7 +652,7 @@ PRIVATE int _list_stats(
 
     uint64_t from_t = kw_get_int(match_cond, "from_t", 0, KW_WILD_NUMBER);
     uint64_t to_t = kw_get_int(match_cond, "to_t", 0, KW_WILD_NUMBER);
-    const char *variable = kw_get_str(match_cond, "variable", "", 0);
+    const char *variable = kw_get_str(match_cond, "variable", variable_?variable_:"", 0);
     const char *metric_name = kw_get_str(match_cond, "metric", metric_name_, 0);
     const char *units = kw_get_str(match_cond, "units", "", 0);
 
@@ -420,10 +752,35 @@ PRIVATE int _list_stats(
         from_t = 1;
     }
 
-    json_t *jn_data = rstats_get_data(metric, from_t, to_t);
-    if(jn_data) {
-        print_json(jn_data);
-        JSON_DECREF(jn_data);
+    if(kw_get_int(match_cond, "compare_to_t", 0, KW_WILD_NUMBER)) {
+        compare_windows(
+            metric,
+            from_t,
+            to_t,
+            kw_get_int(match_cond, "compare_from_t", 1, KW_WILD_NUMBER),
+            kw_get_int(match_cond, "compare_to_t", 0, KW_WILD_NUMBER)
+        );
+    } else {
+        json_t *jn_data;
+        const char *cache_dir = kw_get_str(match_cond, "cache_dir", "", 0);
+        if(!empty_string(cache_dir) && empty_string(units) && !empty_string(metric_name)) {
+            char metric_dir[PATH_MAX];
+            char key[PATH_MAX+256];
+            if(!empty_string(group_name)) {
+                snprintf(metric_dir, sizeof(metric_dir), "%s/%s/%s", path, group_name, metric_name);
+            } else {
+                snprintf(metric_dir, sizeof(metric_dir), "%s/%s", path, metric_name);
+            }
+            snprintf(key, sizeof(key), "%s|%s|%s", metric_dir, variable, metric_name);
+            jn_data = cache_get_data(cache_dir, metric_dir, key, metric, from_t, to_t);
+        } else {
+            jn_data = rstats_get_data(metric, from_t, to_t);
+        }
+        if(jn_data) {
+            apply_transforms(jn_data, match_cond);
+            print_json(jn_data);
+            JSON_DECREF(jn_data);
+        }
     }
 
     /*
@@ -538,92 +895,705 @@ PRIVATE int list_stats(list_params_t *list_params)
         list_params->path_simple_stats,
         list_params->arguments->group,
         list_params->arguments->metric,
+        0,
         list_params->match_cond,
         list_params->arguments->verbose
     );
 }
 
 /***************************************************************************
- *
+ *  Filters of group, metric and variable names.
+ *  Compiled once, matched inside the walk.
  ***************************************************************************/
-PRIVATE BOOL list_recursive_groups_cb(
-    void *user_data,
-    wd_found_type type,     // type found
-    char *fullpath,         // directory+filename found
-    const char *directory,  // directory of found filename
-    char *name,             // name of type found
-    int level,              // level of tree where file found
-    int index               // index of file inside of directory, relative to 0
+PRIVATE int filter_setup(name_filter_t *filter, const char *value, BOOL is_regex)
+{
+    memset(filter, 0, sizeof(*filter));
+    if(empty_string(value)) {
+        return 0;
+    }
+    filter->active = TRUE;
+    filter->exact = value;
+    if(is_regex) {
+        size_t size = strlen(value) + sizeof("^()$");
+        char *pattern = gbmem_malloc(size);
+        if(!pattern) {
+            fprintf(stderr, "No memory for regular expression: '%s'\n\n", value);
+            exit(-1);
+        }
+        snprintf(pattern, size, "^(%s)$", value);
+        int ret = regcomp(&filter->re, pattern, REG_EXTENDED|REG_NOSUB);
+        gbmem_free(pattern);
+        if(ret!=0) {
+            fprintf(stderr, "Bad regular expression: '%s'\n\n", value);
+            exit(-1);
+        }
+        filter->is_regex = TRUE;
+    }
+    return 0;
+}
+
+PRIVATE BOOL filter_match(name_filter_t *filter, const char *name)
+{
+    if(!filter->active) {
+        return TRUE;
+    }
+    if(filter->is_regex) {
+        return regexec(&filter->re, name, 0, 0, 0)==0;
+    }
+    return strcmp(filter->exact, name)==0;
+}
+
+PRIVATE void filter_free(name_filter_t *filter)
+{
+    if(filter->is_regex) {
+        regfree(&filter->re);
+    }
+    memset(filter, 0, sizeof(*filter));
+}
+
+/***************************************************************************
+ *  Iterate the subdirectories of path.
+ *  Return the next one in subdir/name, FALSE at end.
+ ***************************************************************************/
+PRIVATE BOOL next_subdir(DIR *dir, const char *path, char *subdir, int subdir_size, char **name)
+{
+    struct dirent *de;
+    while((de = readdir(dir))) {
+        if(de->d_name[0] == '.') {
+            continue;
+        }
+        if(de->d_type != DT_DIR && de->d_type != DT_UNKNOWN) {
+            continue;
+        }
+        build_path2(subdir, subdir_size, path, de->d_name);
+        if(de->d_type == DT_UNKNOWN && !is_directory(subdir)) {
+            continue;
+        }
+        *name = de->d_name;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/***************************************************************************
+ *  Collect a metric directory if it matches the filters.
+ ***************************************************************************/
+PRIVATE void collect_metric(
+    list_params_t *list_params,
+    const char *directory,
+    const char *group,
+    const char *metric_name
 )
 {
-    list_params_t *list_params = user_data;
+    if(!filter_match(&list_params->metric_filter, metric_name)) {
+        return;
+    }
 
-    pop_last_segment(fullpath); // remove __metric__.json
-    char *metric_name = pop_last_segment(fullpath);
-    if(empty_string(list_params->arguments->group)) {
-        if(level > 2) {
-            list_params->arguments->group = pop_last_segment(fullpath);
+    /*
+     *  The variable is only known by the metric descriptor,
+     *  load it (it's small) only when there is a variable filter.
+     */
+    json_t *jn_desc = 0;
+    const char *variable = 0;
+    if(list_params->variable_filter.active) {
+        char path[PATH_MAX];
+        build_path2(path, sizeof(path), directory, "__metric__.json");
+        jn_desc = json_load_file(path, 0, 0);
+        if(jn_desc) {
+            variable = kw_get_str(jn_desc, "variable", 0, 0);
+        }
+        if(!variable || !filter_match(&list_params->variable_filter, variable)) {
+            JSON_DECREF(jn_desc);
+            return;
         }
     }
 
-    _list_stats(
-        list_params->path_simple_stats,
-        list_params->arguments->group,
-        metric_name,
-        list_params->match_cond,
-        list_params->arguments->verbose
+    json_t *jn_metric = json_pack("{s:s, s:s}",
+        "directory", directory,
+        "metric", metric_name
     );
+    if(group) {
+        json_object_set_new(jn_metric, "group", json_string(group));
+    }
+    if(variable) {
+        json_object_set_new(jn_metric, "variable", json_string(variable));
+    }
+    json_array_append_new(list_params->jn_found, jn_metric);
 
-    return TRUE; // to continue
+    JSON_DECREF(jn_desc);
 }
 
-PRIVATE int list_recursive_groups(list_params_t *list_params)
+/***************************************************************************
+ *  Walk a stats database: database/[group/]metric/__metric__.json
+ *  Groups and metrics not matching the filters are pruned by name,
+ *  before opening anything inside them.
+ ***************************************************************************/
+PRIVATE void collect_metrics(list_params_t *list_params, const char *path, const char *group)
 {
-    walk_dir_tree(
-        list_params->arguments->path,
-        ".*\\__metric__\\.json",
-        WD_RECURSIVE|WD_MATCH_REGULAR_FILE,
-        list_recursive_groups_cb,
-        list_params
+    DIR *dir = opendir(path);
+    if(!dir) {
+        return;
+    }
+
+    char subdir[PATH_MAX];
+    char *name;
+    while(next_subdir(dir, path, subdir, sizeof(subdir), &name)) {
+        if(file_exists(subdir, "__metric__.json")) {
+            if(!group && list_params->group_filter.active) {
+                continue; // metric without group
+            }
+            collect_metric(list_params, subdir, group, name);
+
+        } else if(!group) {
+            if(!filter_match(&list_params->group_filter, name)) {
+                continue;
+            }
+            collect_metrics(list_params, subdir, name);
+        }
+    }
+    closedir(dir);
+}
+
+/***************************************************************************
+ *  Read ahead the data files of a metric overlapping the range asked.
+ *  The files are in the "data" of the metric descriptor,
+ *  the group is opened here, in the main thread, once for all its metrics.
+ ***************************************************************************/
+PRIVATE void readahead_close_group(list_params_t *list_params)
+{
+    JSON_DECREF(list_params->readahead_variables);
+    if(list_params->readahead_stats) {
+        rstats_close(list_params->readahead_stats);
+        list_params->readahead_stats = 0;
+    }
+    list_params->readahead_group[0] = 0;
+}
+
+PRIVATE void readahead_metric(list_params_t *list_params, json_t *jn_metric)
+{
+    json_t *match_cond = list_params->match_cond;
+    const char *variable = kw_get_str(match_cond, "variable",
+        kw_get_str(jn_metric, "variable", "", 0), 0
     );
+    if(empty_string(variable)) {
+        return; // "What Variable?", no data will be read
+    }
+    const char *group = kw_get_str(jn_metric, "group", "", 0);
+    const char *metric_name = kw_get_str(jn_metric, "metric", "", KW_REQUIRED);
+
+    if(!list_params->readahead_stats || strcmp(list_params->readahead_group, group)!=0) {
+        readahead_close_group(list_params);
+        json_t *jn_stats = json_pack("{s:s, s:s}",
+            "path", list_params->path_simple_stats,
+            "groups", group
+        );
+        list_params->readahead_stats = rstats_open(jn_stats);
+        if(!list_params->readahead_stats) {
+            return;
+        }
+        list_params->readahead_variables = rstats_variables(list_params->readahead_stats);
+        snprintf(list_params->readahead_group, sizeof(list_params->readahead_group), "%s", group);
+    }
+
+    json_t *jn_variable = json_object_get(list_params->readahead_variables, variable);
+    json_t *jn_metr = json_object_get(jn_variable, metric_name);
+    json_t *jn_files = json_object_get(jn_metr, "data");
+    if(!json_is_array(jn_files)) {
+        return;
+    }
+
+    uint64_t from_t = kw_get_int(match_cond, "from_t", 0, KW_WILD_NUMBER);
+    uint64_t to_t = kw_get_int(match_cond, "to_t", 0, KW_WILD_NUMBER);
+    if(!to_t) {
+        to_t = (uint64_t)-1;
+    }
+
+    /*
+     *  At most READAHEAD_FILES per metric, so the metrics behind find room in the ring.
+     *  Files are in time order: walk backwards, the most recent ones first.
+     */
+    int submitted = 0;
+    for(size_t idx = json_array_size(jn_files); idx > 0 && submitted < READAHEAD_FILES; idx--) {
+        json_t *jn_file = json_array_get(jn_files, idx-1);
+        uint64_t file_fr_t = kw_get_int(jn_file, "fr_t", 0, KW_WILD_NUMBER);
+        uint64_t file_to_t = kw_get_int(jn_file, "to_t", 0, KW_WILD_NUMBER);
+        const char *file = kw_get_str(jn_file, "file", 0, 0);
+        if(!file_to_t || empty_string(file)) {
+            continue; // unknown range or file, don't read it blindly
+        }
+        if(file_fr_t > to_t || file_to_t < from_t) {
+            continue;
+        }
+        char path[PATH_MAX];
+        build_path2(path, sizeof(path), kw_get_str(jn_metric, "directory", "", KW_REQUIRED), file);
+        if(readahead_submit(list_params->readahead, path)<0) {
+            break; // ring full
+        }
+        submitted++;
+    }
+}
+
+PRIVATE int list_recursive_groups(list_params_t *list_params)
+{
+    /*
+     *  Only collect, the listing is done later
+     *  so the next metrics can be read ahead while the current is parsed.
+     */
+    list_params->jn_found = json_array();
+    collect_metrics(list_params, list_params->path_simple_stats, 0);
+
+    int depth = list_params->arguments->readahead;
+    if(list_params->readahead) {
+        for(int i=0; i<depth; i++) {
+            json_t *jn_next = json_array_get(list_params->jn_found, i);
+            if(!jn_next) {
+                break;
+            }
+            readahead_metric(list_params, jn_next);
+        }
+    }
+
+    size_t idx;
+    json_t *jn_metric;
+    json_array_foreach(list_params->jn_found, idx, jn_metric) {
+        if(list_params->readahead) {
+            json_t *jn_next = json_array_get(list_params->jn_found, idx + depth);
+            if(jn_next) {
+                readahead_metric(list_params, jn_next);
+            }
+        }
+
+        _list_stats(
+            list_params->path_simple_stats,
+            (char *)kw_get_str(jn_metric, "group", 0, 0),
+            (char *)kw_get_str(jn_metric, "metric", "", KW_REQUIRED),
+            kw_get_str(jn_metric, "variable", 0, 0),
+            list_params->match_cond,
+            list_params->arguments->verbose
+        );
+    }
+
+    readahead_close_group(list_params);
+    JSON_DECREF(list_params->jn_found);
 
     return 0;
 }
 
 /***************************************************************************
- *
+ *  Find the stats databases under path.
+ *  Don't go down inside a database, there are only its groups and metrics.
  ***************************************************************************/
-PRIVATE BOOL list_recursive_cb(
-    void *user_data,
-    wd_found_type type,     // type found
-    char *fullpath,         // directory+filename found
-    const char *directory,  // directory of found filename
-    char *name,             // name of type found
-    int level,              // level of tree where file found
-    int index               // index of file inside of directory, relative to 0
+PRIVATE int list_recursive(list_params_t *list_params, const char *path)
+{
+    if(file_exists(path, "__simple_stats__.json")) {
+        if(list_params->jn_groups) {
+            return collect_groups(list_params, path);
+        }
+        snprintf(list_params->path_simple_stats, sizeof(list_params->path_simple_stats), "%s", path);
+        return list_recursive_groups(list_params);
+    }
+
+    DIR *dir = opendir(path);
+    if(!dir) {
+        return -1;
+    }
+
+    char subdir[PATH_MAX];
+    char *name;
+    while(next_subdir(dir, path, subdir, sizeof(subdir), &name)) {
+        list_recursive(list_params, subdir);
+    }
+    closedir(dir);
+
+    return 0;
+}
+
+/***************************************************************************
+ *  Collect the groups of a database to be scanned for gaps.
+ ***************************************************************************/
+PRIVATE int collect_groups(list_params_t *list_params, const char *database)
+{
+    DIR *dir = opendir(database);
+    if(!dir) {
+        return -1;
+    }
+
+    BOOL root_metrics = FALSE;
+    char subdir[PATH_MAX];
+    char *name;
+    while(next_subdir(dir, database, subdir, sizeof(subdir), &name)) {
+        if(file_exists(subdir, "__metric__.json")) {
+            root_metrics = TRUE;
+            continue;
+        }
+        if(!filter_match(&list_params->group_filter, name)) {
+            continue;
+        }
+        json_array_append_new(list_params->jn_groups, json_pack("{s:s, s:s}",
+            "database", database,
+            "group", name
+        ));
+    }
+    closedir(dir);
+
+    if(root_metrics && !list_params->group_filter.active) {
+        json_array_append_new(list_params->jn_groups, json_pack("{s:s, s:s}",
+            "database", database,
+            "group", ""
+        ));
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+ *  Nominal seconds of a period, 0 if unknown.
+ *  Calendar periods (MON, YEAR, CENT) have no fixed length,
+ *  their value is only used to size the slices of reading.
+ ***************************************************************************/
+PRIVATE uint64_t period_seconds(const char *period, BOOL *calendar)
+{
+    static const struct {
+        const char *period;
+        uint64_t seconds;
+        BOOL calendar;
+    } periods[] = {
+        {"SEC",     1,                      FALSE},
+        {"MIN",     60,                     FALSE},
+        {"HOUR",    60*60,                  FALSE},
+        {"MDAY",    24*60*60,               FALSE},
+        {"WDAY",    24*60*60,               FALSE},
+        {"YDAY",    24*60*60,               FALSE},
+        {"MON",     31*24*60*60,            TRUE},
+        {"YEAR",    366*24*60*60LL,         TRUE},
+        {"CENT",    100*366*24*60*60LL,     TRUE},
+        {0}
+    };
+
+    *calendar = FALSE;
+    for(int i=0; periods[i].period; i++) {
+        if(strcasecmp(periods[i].period, period)==0) {
+            *calendar = periods[i].calendar;
+            return periods[i].seconds;
+        }
+    }
+    return 0;
+}
+
+/***************************************************************************
+ *  Start of the calendar bucket `n` buckets after the one of t.
+ ***************************************************************************/
+PRIVATE uint64_t calendar_bucket_start(uint64_t t, const char *period, int n)
+{
+    time_t tt = (time_t)t;
+    struct tm tm;
+    gmtime_r(&tt, &tm);
+
+    tm.tm_sec = 0;
+    tm.tm_min = 0;
+    tm.tm_hour = 0;
+    tm.tm_mday = 1;
+    if(strcasecmp(period, "MON")==0) {
+        tm.tm_mon += n;
+    } else if(strcasecmp(period, "YEAR")==0) {
+        tm.tm_mon = 0;
+        tm.tm_year += n;
+    } else { // CENT
+        tm.tm_mon = 0;
+        tm.tm_year = ((tm.tm_year + 1900)/100 + n)*100 - 1900;
+    }
+    return (uint64_t)timegm(&tm);
+}
+
+/***************************************************************************
+ *  State of the scan of a metric, only the last record is kept.
+ ***************************************************************************/
+typedef struct {
+    FILE *out;
+    const char *period;
+    uint64_t period_secs;
+    BOOL calendar;
+
+    BOOL first;
+    uint64_t last_fr_t;
+    uint64_t last_to_t;
+    char last_to_d[64];
+    int gaps;
+} metric_scan_t;
+
+PRIVATE void scan_records(metric_scan_t *ms, json_t *metric, uint64_t fr_t, uint64_t to_t)
+{
+    json_t *jn_data = rstats_get_data(metric, fr_t, to_t);
+    size_t idx;
+    json_t *jn_record;
+    json_array_foreach(jn_data, idx, jn_record) {
+        uint64_t r_fr_t = kw_get_int(jn_record, "fr_t", 0, KW_REQUIRED|KW_WILD_NUMBER);
+        uint64_t r_to_t = kw_get_int(jn_record, "to_t", 0, KW_REQUIRED|KW_WILD_NUMBER);
+        if(!ms->first && r_to_t <= ms->last_to_t) {
+            continue; // already seen, files or slices can overlap
+        }
+        if(!ms->first) {
+            BOOL gap;
+            if(ms->calendar) {
+                /*
+                 *  A bucket is missing if next record starts
+                 *  in the second calendar bucket after the last one or later.
+                 */
+                gap = r_fr_t >= calendar_bucket_start(ms->last_fr_t, ms->period, 2);
+            } else {
+                gap = ms->period_secs && r_fr_t > ms->last_to_t &&
+                    r_fr_t - ms->last_to_t >= ms->period_secs;
+            }
+            if(gap) {
+                fprintf(ms->out, "    Gap:   %s -> %s (%llu seconds)\n",
+                    ms->last_to_d,
+                    kw_get_str(jn_record, "fr_d", "", 0),
+                    (unsigned long long)(r_fr_t - ms->last_to_t)
+                );
+                ms->gaps++;
+            }
+        }
+        ms->first = FALSE;
+        ms->last_fr_t = r_fr_t;
+        ms->last_to_t = r_to_t;
+        snprintf(ms->last_to_d, sizeof(ms->last_to_d), "%s", kw_get_str(jn_record, "to_d", "", 0));
+    }
+    JSON_DECREF(jn_data);
+}
+
+/***************************************************************************
+ *  Scan the records of a metric looking for gaps and staleness.
+ *  Records are read file by file (the "data" of the metric descriptor),
+ *  or, when the files have no range, in slices of GAPS_SLICE_PERIODS periods.
+ *  Only the last record is kept between reads: constant memory per metric.
+ ***************************************************************************/
+PRIVATE void scan_metric(
+    gaps_scan_t *scan,
+    const char *database,
+    const char *group,
+    json_t *variables,
+    const char *variable,
+    const char *metric_name,
+    json_t *jn_metr
 )
 {
-    list_params_t *list_params = user_data;
+    json_t *metric = rstats_metric(variables, variable, metric_name, "", FALSE);
+    if(!metric) {
+        return;
+    }
 
-    pop_last_segment(fullpath); // remove __simple_stats__.json
-    list_params->arguments->path = fullpath;
-    snprintf(list_params->path_simple_stats, sizeof(list_params->path_simple_stats), "%s", fullpath);
-    list_recursive_groups(list_params);
+    char *report = 0;
+    size_t report_size = 0;
+    FILE *out = open_memstream(&report, &report_size);
+    if(!out) {
+        JSON_DECREF(metric);
+        return;
+    }
 
-    return TRUE; // to continue
+    metric_scan_t ms;
+    memset(&ms, 0, sizeof(ms));
+    ms.out = out;
+    ms.first = TRUE;
+    ms.period = kw_get_str(jn_metr, "period", "", 0);
+    ms.period_secs = period_seconds(ms.period, &ms.calendar);
+
+    json_t *jn_files = kw_get_list(jn_metr, "data", 0, 0);
+    json_t *jn_first = json_array_get(jn_files, 0);
+    int stale = 0;
+    int unscanned = 0;
+
+    if(kw_get_int(jn_first, "to_t", 0, KW_WILD_NUMBER)) {
+        size_t idx;
+        json_t *jn_file;
+        json_array_foreach(jn_files, idx, jn_file) {
+            uint64_t to_t = kw_get_int(jn_file, "to_t", 0, KW_WILD_NUMBER);
+            if(!to_t) {
+                to_t = (uint64_t)-1; // file without end, the live one
+            }
+            scan_records(&ms, metric,
+                kw_get_int(jn_file, "fr_t", 1, KW_WILD_NUMBER),
+                to_t
+            );
+        }
+    } else if(jn_first) {
+        uint64_t start_t = kw_get_int(jn_first, "fr_t", 0, KW_WILD_NUMBER);
+        if(!start_t) {
+            start_t = approxidate(kw_get_str(jn_first, "fr_d", "", 0));
+        }
+        uint64_t slice = GAPS_SLICE_PERIODS * (ms.period_secs? ms.period_secs : 60*60);
+        uint64_t now = (uint64_t)time(0);
+        if(!start_t) {
+            fprintf(out, "    Unknown range, not scanned\n");
+            unscanned++;
+        }
+        for(uint64_t fr_t = start_t; start_t; fr_t += slice) {
+            if(fr_t + slice > now) {
+                scan_records(&ms, metric, fr_t, (uint64_t)-1); // last slice, until the end
+                break;
+            }
+            scan_records(&ms, metric, fr_t, fr_t + slice - 1);
+        }
+    }
+
+    if(scan->stale_t) {
+        if(ms.first) {
+            fprintf(out, "    Stale: no data\n");
+            stale++;
+        } else if(ms.last_to_t < scan->stale_t) {
+            fprintf(out, "    Stale: last %s\n", ms.last_to_d);
+            stale++;
+        }
+    }
+    fclose(out);
+
+    pthread_mutex_lock(&scan->mutex);
+    scan->metrics++;
+    scan->gaps += ms.gaps;
+    scan->stale += stale;
+    scan->unscanned += unscanned;
+    if(ms.gaps || stale || unscanned) {
+        printf("Database: %s, Group: '%s', Variable: %s, Metric: %s\n",
+            database, group, variable, metric_name
+        );
+        fwrite(report, 1, report_size, stdout);
+        fflush(stdout);
+    }
+    pthread_mutex_unlock(&scan->mutex);
+
+    free(report);
+    JSON_DECREF(metric);
 }
 
-PRIVATE int list_recursive(list_params_t *list_params)
+/***************************************************************************
+ *
+ ***************************************************************************/
+PRIVATE void scan_group(gaps_scan_t *scan, json_t *jn_group)
 {
-    walk_dir_tree(
-        list_params->arguments->path,
-        ".*\\__simple_stats__\\.json",
-        WD_RECURSIVE|WD_MATCH_REGULAR_FILE,
-        list_recursive_cb,
-        list_params
+    list_params_t *list_params = scan->list_params;
+    const char *database = kw_get_str(jn_group, "database", "", KW_REQUIRED);
+    const char *group = kw_get_str(jn_group, "group", "", KW_REQUIRED);
+
+    json_t *jn_stats = json_pack("{s:s, s:s}",
+        "path", database,
+        "groups", group
     );
+    json_t *stats = rstats_open(jn_stats);
+    if(!stats) {
+        pthread_mutex_lock(&scan->mutex);
+        fprintf(stderr, "Can't open stats %s/%s\n\n", database, group);
+        pthread_mutex_unlock(&scan->mutex);
+        return;
+    }
+    json_t *variables = rstats_variables(stats);
 
-    return 0;
+    const char *var;
+    json_t *jn_v;
+    json_object_foreach(variables, var, jn_v) {
+        if(!filter_match(&list_params->variable_filter, var)) {
+            continue;
+        }
+        const char *metr;
+        json_t *jn_metr;
+        json_object_foreach(jn_v, metr, jn_metr) {
+            if(!filter_match(&list_params->metric_filter, metr)) {
+                continue;
+            }
+            scan_metric(scan, database, group, variables, var, metr, jn_metr);
+        }
+    }
+
+    JSON_DECREF(variables);
+    rstats_close(stats);
+}
+
+PRIVATE void gaps_worker(gaps_scan_t *scan)
+{
+    while(1) {
+        pthread_mutex_lock(&scan->mutex);
+        size_t idx = scan->next++;
+        pthread_mutex_unlock(&scan->mutex);
+
+        json_t *jn_group = json_array_get(scan->list_params->jn_groups, idx);
+        if(!jn_group) {
+            break;
+        }
+        scan_group(scan, jn_group);
+    }
+}
+
+/***************************************************************************
+ *  Scan all the groups found, in parallel.
+ *  The helpers (json, gbmem, rstats) are not thread-safe:
+ *  each worker is a forked process with its own copy of them.
+ *  Only the scan state lives in shared memory, protected by a
+ *  process-shared mutex: next group, counters and stdout.
+ ***************************************************************************/
+PRIVATE int gaps_scan(list_params_t *list_params, uint64_t stale_t, int jobs)
+{
+    gaps_scan_t *scan = mmap(0, sizeof(gaps_scan_t),
+        PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0
+    );
+    if(scan == MAP_FAILED) {
+        fprintf(stderr, "Can't map shared memory: %s\n\n", strerror(errno));
+        exit(-1);
+    }
+    memset(scan, 0, sizeof(gaps_scan_t));
+    scan->list_params = list_params;
+    scan->stale_t = stale_t;
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(&scan->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    if(jobs <= 0) {
+        jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    jobs = MIN(jobs, (int)json_array_size(list_params->jn_groups));
+
+    int started = 0;
+    if(jobs > 1) {
+        fflush(stdout);
+        fflush(stderr);
+        for(int i=0; i<jobs; i++) {
+            pid_t pid = fork();
+            if(pid < 0) {
+                break;
+            }
+            if(pid == 0) {
+                gaps_worker(scan);
+                fflush(stdout);
+                fflush(stderr);
+                _exit(0);
+            }
+            started++;
+        }
+    }
+    if(started == 0) {
+        gaps_worker(scan);
+    }
+    while(started > 0) {
+        if(wait(0) >= 0) {
+            started--;
+        } else if(errno != EINTR) {
+            break;
+        }
+    }
+
+    printf("\nGroups: %lu, Metrics: %d, Gaps: %d, Stale: %d, Not scanned: %d\n",
+        (unsigned long)json_array_size(list_params->jn_groups),
+        scan->metrics,
+        scan->gaps,
+        scan->stale,
+        scan->unscanned
+    );
+    int ret = (scan->gaps || scan->stale || scan->unscanned)? -1 : 0;
+
+    pthread_mutex_destroy(&scan->mutex);
+    munmap(scan, sizeof(gaps_scan_t));
+
+    return ret;
 }
 
 /***************************************************************************
@@ -635,6 +1605,7 @@ int main(int argc, char *argv[])
      *  Default values
      */
     memset(&arguments, 0, sizeof(arguments));
+    arguments.readahead = READAHEAD_DEPTH;
 
     /*
      *  Parse arguments
@@ -713,7 +1684,51 @@ int main(int argc, char *argv[])
         json_object_set_new(match_cond, "to_t", json_integer(timestamp));
     }
 
-    if(arguments.variable) {
+    if(arguments.compare) {
+        char from2[256];
+        snprintf(from2, sizeof(from2), "%s", arguments.compare);
+        char *to2 = strchr(from2, ',');
+        if(!to2) {
+            fprintf(stderr, "Bad compare window, use FROM,TO: '%s'\n", arguments.compare);
+            exit(-1);
+        }
+        *to2++ = 0;
+
+        timestamp_t from2_t = all_numbers(from2)? atoll(from2) : approxidate(from2);
+        timestamp_t to2_t;
+        if(empty_string(to2)) {
+            to2_t = (timestamp_t)-1;
+        } else {
+            to2_t = all_numbers(to2)? atoll(to2) : approxidate(to2);
+        }
+        json_object_set_new(match_cond, "compare_from_t", json_integer(from2_t));
+        json_object_set_new(match_cond, "compare_to_t", json_integer(to2_t));
+    }
+
+    if(arguments.rolling) {
+        int window = atoi(arguments.rolling);
+        if(window <= 0) {
+            fprintf(stderr, "Bad rolling window: '%s'\n", arguments.rolling);
+            exit(-1);
+        }
+        const char *fn = arguments.rolling_fn? arguments.rolling_fn : "mean";
+        if(rolling_fn_from_name(fn) < 0) {
+            fprintf(stderr, "Bad rolling function: '%s'\n", fn);
+            exit(-1);
+        }
+        json_object_set_new(match_cond, "rolling", json_integer(window));
+        json_object_set_new(match_cond, "rolling_fn", json_string(fn));
+    }
+    if(arguments.ewma) {
+        double alpha = atof(arguments.ewma);
+        if(!(alpha > 0 && alpha <= 1)) {
+            fprintf(stderr, "Bad ewma alpha: '%s'\n", arguments.ewma);
+            exit(-1);
+        }
+        json_object_set_new(match_cond, "ewma", json_real(alpha));
+    }
+
+    if(arguments.variable && !(arguments.recursive && arguments.regex)) {
         json_object_set_new(
             match_cond,
             "variable",
@@ -727,6 +1742,13 @@ int main(int argc, char *argv[])
             json_string(arguments.units)
         );
     }
+    if(arguments.cache_dir) {
+        json_object_set_new(
+            match_cond,
+            "cache_dir",
+            json_string(arguments.cache_dir)
+        );
+    }
     if(arguments.limits) {
         json_object_set_new(
             match_cond,
@@ -740,6 +1762,15 @@ int main(int argc, char *argv[])
         JSON_DECREF(match_cond);
     }
 
+    if(arguments.regex && !(arguments.recursive || arguments.gaps)) {
+        fprintf(stderr, "--regex only applies to recursive listing (-r) or --gaps\n");
+        exit(-1);
+    }
+    if(arguments.regex && arguments.raw && !arguments.gaps) {
+        fprintf(stderr, "--regex can't be used with --raw\n");
+        exit(-1);
+    }
+
     /*
      *  Do your work
      */
@@ -753,16 +1784,53 @@ int main(int argc, char *argv[])
     list_params.arguments = &arguments;
     list_params.match_cond = match_cond;
 
-    if(arguments.raw) {
+    int ret = 0;
+    if(arguments.gaps) {
+        uint64_t stale_t = 0;
+        if(arguments.stale) {
+            stale_t = all_numbers(arguments.stale)? atoll(arguments.stale) : approxidate(arguments.stale);
+        }
+        filter_setup(&list_params.group_filter, arguments.group, arguments.regex);
+        filter_setup(&list_params.metric_filter, arguments.metric, arguments.regex);
+        filter_setup(&list_params.variable_filter, arguments.variable, arguments.regex);
+
+        list_params.jn_groups = json_array();
+        list_recursive(&list_params, arguments.path);
+        ret = gaps_scan(&list_params, stale_t, arguments.jobs);
+        JSON_DECREF(list_params.jn_groups);
+
+        filter_free(&list_params.group_filter);
+        filter_free(&list_params.metric_filter);
+        filter_free(&list_params.variable_filter);
+    } else if(arguments.raw) {
         _list_stats(
             arguments.path,
             arguments.group,
             arguments.metric,
+            0,
             match_cond,
             arguments.verbose
         );
     } else if(arguments.recursive) {
-        list_recursive(&list_params);
+        /*
+         *  Read ahead only when data is going to be read: a range is asked.
+         */
+        if(arguments.readahead > 0 && (arguments.from_t || arguments.to_t) && !arguments.limits) {
+            list_params.readahead = readahead_create(
+                READAHEAD_WORKERS,
+                arguments.readahead * READAHEAD_FILES
+            );
+        }
+        filter_setup(&list_params.group_filter, arguments.group, arguments.regex);
+        filter_setup(&list_params.metric_filter, arguments.metric, arguments.regex);
+        filter_setup(&list_params.variable_filter, arguments.variable, arguments.regex);
+
+        list_recursive(&list_params, arguments.path);
+
+        filter_free(&list_params.group_filter);
+        filter_free(&list_params.metric_filter);
+        filter_free(&list_params.variable_filter);
+        readahead_destroy(list_params.readahead);
     } else {
         list_stats(&list_params);
     }
@@ -772,5 +1840,5 @@ int main(int argc, char *argv[])
     gbmem_shutdown();
     log_end();
 
-    return 0;
+    return ret;
 }
@@ -0,0 +1,182 @@
+/****************************************************************************
+ *          TRANSFORMS.C
+ *
+ *          Streaming transforms of series: rolling window and EWMA.
+ *
+ *          Copyright (c) 2018 Niyamaka.
+ *          All Rights Reserved.
+ ****************************************************************************/
+#include <math.h>
+#include <string.h>
+#include <strings.h>
+#include <ghelpers.h>
+#include "transforms.h"
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+int rolling_fn_from_name(const char *name)
+{
+    if(strcasecmp(name, "mean")==0) {
+        return ROLLING_MEAN;
+    } else if(strcasecmp(name, "max")==0) {
+        return ROLLING_MAX;
+    } else if(strcasecmp(name, "stddev")==0) {
+        return ROLLING_STDDEV;
+    }
+    return -1;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+int rolling_init(rolling_t *rolling, rolling_fn_t fn, size_t window)
+{
+    memset(rolling, 0, sizeof(*rolling));
+    if(window == 0) {
+        return -1;
+    }
+    rolling->fn = fn;
+    rolling->window = window;
+    rolling->values = gbmem_malloc(window * sizeof(double));
+    rolling->deque = gbmem_malloc(window * sizeof(rolling_entry_t));
+    if(!rolling->values || !rolling->deque) {
+        rolling_end(rolling);
+        return -1;
+    }
+    return 0;
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+void rolling_end(rolling_t *rolling)
+{
+    if(rolling->values) {
+        gbmem_free(rolling->values);
+    }
+    if(rolling->deque) {
+        gbmem_free(rolling->deque);
+    }
+    memset(rolling, 0, sizeof(*rolling));
+}
+
+/***************************************************************************
+ *  Monotonic deque: the front is the max of the window,
+ *  values behind a greater or equal newer one can never be the max.
+ ***************************************************************************/
+PRIVATE double deque_push(rolling_t *rolling, double value, size_t index)
+{
+    size_t window = rolling->window;
+
+    while(rolling->dq_len > 0) {
+        size_t back = (rolling->dq_head + rolling->dq_len - 1) % window;
+        if(rolling->deque[back].value > value) {
+            break;
+        }
+        rolling->dq_len--;
+    }
+    while(rolling->dq_len > 0 && rolling->deque[rolling->dq_head].index + window <= index) {
+        rolling->dq_head = (rolling->dq_head + 1) % window;
+        rolling->dq_len--;
+    }
+
+    size_t tail = (rolling->dq_head + rolling->dq_len) % window;
+    rolling->deque[tail].value = value;
+    rolling->deque[tail].index = index;
+    rolling->dq_len++;
+
+    return rolling->deque[rolling->dq_head].value;
+}
+
+/***************************************************************************
+ *  Sums of the window recomputed from the ring,
+ *  shifted around the newest value.
+ ***************************************************************************/
+PRIVATE void rolling_resum(rolling_t *rolling, size_t newest)
+{
+    rolling->shift = rolling->values[newest];
+    rolling->s1 = 0;
+    rolling->s2 = 0;
+    for(size_t i=0; i<rolling->window; i++) {
+        double d = rolling->values[i] - rolling->shift;
+        rolling->s1 += d;
+        rolling->s2 += d * d;
+    }
+}
+
+/***************************************************************************
+ *  Mean and variance from sums of the values shifted by a reference
+ *  (the first value, then the newest one at every recompute),
+ *  so the sums stay small even with big values.
+ *  Adding and removing values accumulates rounding errors,
+ *  the sums are recomputed from the ring every `window` values:
+ *  still O(1) amortized per value.
+ ***************************************************************************/
+double rolling_push(rolling_t *rolling, double value)
+{
+    size_t index = rolling->count++;
+    size_t pos = index % rolling->window;
+    size_t n;
+
+    if(index == 0) {
+        rolling->shift = value;
+    }
+    if(index < rolling->window) {
+        n = index + 1;
+    } else {
+        n = rolling->window;
+        double d = rolling->values[pos] - rolling->shift;
+        rolling->s1 -= d;
+        rolling->s2 -= d * d;
+    }
+    rolling->values[pos] = value;
+
+    double d = value - rolling->shift;
+    rolling->s1 += d;
+    rolling->s2 += d * d;
+
+    if(index + 1 >= rolling->window && (index + 1) % rolling->window == 0) {
+        rolling_resum(rolling, pos);
+    }
+
+    switch(rolling->fn) {
+        case ROLLING_MAX:
+            return deque_push(rolling, value, index);
+        case ROLLING_STDDEV:
+            {
+                if(n == 1) {
+                    return 0;
+                }
+                double mean_d = rolling->s1 / n;
+                double var = rolling->s2 / n - mean_d * mean_d;
+                return var > 0? sqrt(var) : 0;
+            }
+        case ROLLING_MEAN:
+        default:
+            if(n == 1) {
+                return value;
+            }
+            return rolling->shift + rolling->s1 / n;
+    }
+}
+
+/***************************************************************************
+ *
+ ***************************************************************************/
+void ewma_init(ewma_t *ewma, double alpha)
+{
+    memset(ewma, 0, sizeof(*ewma));
+    ewma->alpha = alpha;
+}
+
+double ewma_push(ewma_t *ewma, double value)
+{
+    if(!ewma->started) {
+        ewma->value = value;
+        ewma->started = 1;
+    } else {
+        ewma->value += ewma->alpha * (value - ewma->value);
+    }
+    return ewma->value;
+}
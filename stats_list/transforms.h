@@ -0,0 +1,79 @@
+/****************************************************************************
+ *          TRANSFORMS.H
+ *
+ *          Streaming transforms of series: rolling window and EWMA.
+ *          O(1) state update per value.
+ *
+ *          Copyright (c) 2018 Niyamaka.
+ *          All Rights Reserved.
+ ****************************************************************************/
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/***************************************************************
+ *              Structures
+ ***************************************************************/
+typedef enum {
+    ROLLING_MEAN = 0,
+    ROLLING_MAX,
+    ROLLING_STDDEV,
+} rolling_fn_t;
+
+typedef struct {
+    double value;
+    size_t index;
+} rolling_entry_t;
+
+typedef struct {
+    rolling_fn_t fn;
+    size_t window;
+    size_t count;               // values pushed
+
+    double *values;             // ring with the last `window` values
+    double shift;               // reference value, near the values of the window
+    double s1;                  // running sum of (value - shift) of the window
+    double s2;                  // running sum of (value - shift)^2 of the window
+
+    rolling_entry_t *deque;     // ring of decreasing maxima of the window
+    size_t dq_head;
+    size_t dq_len;
+} rolling_t;
+
+typedef struct {
+    double alpha;
+    double value;
+    int started;
+} ewma_t;
+
+/***************************************************************
+ *              Prototypes
+ ***************************************************************/
+/*
+ *  Return the rolling function of name (mean, max, stddev), -1 if unknown.
+ */
+int rolling_fn_from_name(const char *name);
+
+/*
+ *  Return 0 if ok, -1 if no memory or window is 0.
+ */
+int rolling_init(rolling_t *rolling, rolling_fn_t fn, size_t window);
+void rolling_end(rolling_t *rolling);
+
+/*
+ *  Add a value, return the function over the last `window` values
+ *  (over the values pushed, while they are less than window).
+ *  Stddev is the population one.
+ */
+double rolling_push(rolling_t *rolling, double value);
+
+void ewma_init(ewma_t *ewma, double alpha);
+double ewma_push(ewma_t *ewma, double value);
+
+#ifdef __cplusplus
+}
+#endif